@@ -0,0 +1,557 @@
+#include "DesktopIndex.hpp"
+
+#include <hyprutils/string/VarList.hpp>
+#include <hyprutils/string/String.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <functional>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace Hyprutils::String;
+using namespace Hyprutils::OS;
+
+constexpr const uint32_t WATCH_MASK        = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MOVE_SELF | IN_ONLYDIR;
+constexpr const uint32_t PARENT_WATCH_MASK = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR | IN_MASK_ADD;
+
+static std::vector<std::filesystem::path> applicationDirs() {
+    std::vector<std::filesystem::path> dataDirs;
+
+    const auto                         HOME      = getenv("HOME");
+    const auto                         DATA_HOME = getenv("XDG_DATA_HOME");
+    const auto                         DATA_DIRS = getenv("XDG_DATA_DIRS");
+
+    if (DATA_HOME && *DATA_HOME)
+        dataDirs.emplace_back(DATA_HOME);
+    else if (HOME)
+        dataDirs.emplace_back(std::filesystem::path{HOME} / ".local/share");
+
+    CVarList systemDirs(DATA_DIRS && *DATA_DIRS ? DATA_DIRS : "/usr/local/share:/usr/share", 0, ':', true);
+    for (const auto& d : systemDirs) {
+        dataDirs.emplace_back(d);
+    }
+
+    // flatpak exports, in case the session didn't add them to XDG_DATA_DIRS
+    if (HOME)
+        dataDirs.emplace_back(std::filesystem::path{HOME} / ".local/share/flatpak/exports/share");
+    dataDirs.emplace_back("/var/lib/flatpak/exports/share");
+
+    // the same dir can be listed under different names, e.g. nix profile symlinks
+    std::vector<std::filesystem::path> result, seen;
+    for (const auto& d : dataDirs) {
+        auto            dir = (d / "applications").lexically_normal();
+
+        std::error_code ec;
+        auto            real = std::filesystem::weakly_canonical(dir, ec);
+        if (ec)
+            real = dir;
+
+        if (std::ranges::find(seen, real) != seen.end())
+            continue;
+
+        seen.emplace_back(std::move(real));
+        result.emplace_back(std::move(dir));
+    }
+
+    return result;
+}
+
+static std::string lowercase(std::string str) {
+    std::ranges::transform(str, str.begin(), [](unsigned char c) { return std::tolower(c); });
+    return str;
+}
+
+static std::string fileName(const std::string& path) {
+    return std::filesystem::path(path).filename().string();
+}
+
+bool appInPath(const std::string& binName) {
+    static auto PATH = getenv("PATH");
+
+    if (!PATH)
+        return false;
+
+    static CVarList paths(PATH, 0, ':', true);
+
+    for (const auto& p : paths) {
+        std::error_code ec;
+        if (!std::filesystem::exists(std::filesystem::path(p) / binName, ec) || ec)
+            continue;
+        return true;
+    }
+
+    return false;
+}
+
+// absolute paths have to exist, anything else has to be on PATH, like the spec asks for TryExec
+static bool binaryExists(const std::string& bin) {
+    if (bin.starts_with('/')) {
+        std::error_code ec;
+        return std::filesystem::exists(bin, ec) && !ec;
+    }
+
+    return !bin.empty() && appInPath(bin);
+}
+
+static void addKey(std::vector<std::string>& keys, const std::string& key) {
+    auto k = lowercase(key);
+    if (k.empty() || std::ranges::find(keys, k) != keys.end())
+        return;
+    keys.emplace_back(std::move(k));
+}
+
+// app ids are reverse-DNS (org.wezfurlong.wezterm), the last component is usually the binary name
+static void addAppId(std::vector<std::string>& keys, const std::string& appId) {
+    addKey(keys, appId);
+
+    const auto DOT = appId.rfind('.');
+    if (DOT != std::string::npos)
+        addKey(keys, appId.substr(DOT + 1));
+}
+
+static std::vector<std::string> splitExec(const std::string& exec) {
+    std::vector<std::string> args;
+    std::string              current;
+    bool                     quoted = false, hasArg = false;
+
+    for (size_t i = 0; i < exec.size(); ++i) {
+        const char c = exec[i];
+
+        if (quoted && c == '\\' && i + 1 < exec.size()) {
+            current += exec[++i];
+            continue;
+        }
+
+        if (c == '"') {
+            quoted = !quoted;
+            hasArg = true;
+            continue;
+        }
+
+        if (!quoted && (c == ' ' || c == '\t')) {
+            if (hasArg)
+                args.emplace_back(std::move(current));
+            current.clear();
+            hasArg = false;
+            continue;
+        }
+
+        current += c;
+        hasArg = true;
+    }
+
+    if (hasArg)
+        args.emplace_back(std::move(current));
+
+    return args;
+}
+
+// returns the binary Exec runs, empty if there is none
+static std::string addExecKeys(std::vector<std::string>& keys, const std::string& exec) {
+    const auto ARGS = splitExec(exec);
+    size_t     i    = 0;
+
+    // env VAR=value ... binary
+    if (!ARGS.empty() && fileName(ARGS[0]) == "env") {
+        ++i;
+        while (i < ARGS.size() && (ARGS[i].contains('=') || ARGS[i].starts_with('-'))) {
+            ++i;
+        }
+    }
+
+    if (i >= ARGS.size())
+        return "";
+
+    const auto BIN = fileName(ARGS[i]);
+
+    if (BIN == "flatpak") {
+        // flatpak run [--options] app.id [args]
+        bool run = false;
+        for (size_t j = i + 1; j < ARGS.size(); ++j) {
+            const auto& ARG = ARGS[j];
+
+            if (!run) {
+                run = ARG == "run";
+                continue;
+            }
+
+            if (ARG.starts_with("--command="))
+                addKey(keys, fileName(ARG.substr(10)));
+            else if (!ARG.starts_with('-')) {
+                addAppId(keys, ARG);
+                break;
+            }
+        }
+        return ARGS[i];
+    }
+
+    addKey(keys, BIN);
+
+    // WezTerm-20240203-x86_64.AppImage -> wezterm
+    const auto LOWER = lowercase(BIN);
+    if (LOWER.ends_with(".appimage")) {
+        const auto NAME = LOWER.substr(0, LOWER.length() - 9);
+        addKey(keys, NAME);
+        addKey(keys, NAME.substr(0, NAME.find_first_of("-_")));
+    }
+
+    return ARGS[i];
+}
+
+CDesktopIndex::CDesktopIndex() : m_inotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)), m_roots(applicationDirs()) {}
+
+void CDesktopIndex::addCatalogName(const std::string& binName) {
+    if (m_catalog.emplace(lowercase(binName)).second)
+        m_dirty = true;
+}
+
+void CDesktopIndex::refresh() {
+    if (m_dirty)
+        rescan();
+    else
+        processEvents();
+}
+
+bool CDesktopIndex::provides(const std::string& binName) const {
+    const auto IT = m_keys.find(lowercase(binName));
+    if (IT == m_keys.end())
+        return false;
+
+    // the binary can be gone since the entry was indexed, e.g. a deleted AppImage
+    return std::ranges::any_of(IT->second, [this](const auto& id) {
+        const auto WINNER = winner(m_entries.at(id));
+        return std::ranges::all_of(WINNER->binaries, [](const auto& b) {
+            std::error_code ec;
+            return std::filesystem::exists(b, ec) && !ec;
+        });
+    });
+}
+
+void CDesktopIndex::rescan() {
+    if (m_inotifyFd.isValid()) {
+        for (const auto& [wd, _] : m_watches) {
+            inotify_rm_watch(m_inotifyFd.get(), wd);
+        }
+    }
+
+    m_watches.clear();
+    m_entries.clear();
+    m_keys.clear();
+    m_rootWatched.assign(m_roots.size(), false);
+    m_dirty = false;
+
+    armRoots();
+}
+
+void CDesktopIndex::armRoots() {
+    std::vector<int> parentWatches;
+
+    for (size_t i = 0; i < m_roots.size(); ++i) {
+        if (m_rootWatched[i])
+            continue;
+
+        std::error_code ec;
+        if (std::filesystem::is_directory(m_roots[i], ec) && !ec) {
+            // if it's another root under a different name, it stays unwatched and gets retried when that one goes away
+            m_rootWatched[i] = scanDir(m_roots[i], i);
+            continue;
+        }
+
+        if (!m_inotifyFd.isValid())
+            continue;
+
+        // e.g. the flatpak exports dir doesn't exist before the first flatpak install.
+        // Watch the closest dir that does, and try again when something gets created there.
+        auto parent = m_roots[i].parent_path();
+        while (parent.has_relative_path() && !(std::filesystem::is_directory(parent, ec) && !ec)) {
+            parent = parent.parent_path();
+        }
+
+        const auto WD = inotify_add_watch(m_inotifyFd.get(), parent.c_str(), PARENT_WATCH_MASK);
+        if (WD < 0)
+            continue;
+
+        // IN_MASK_ADD kept the mask of an existing content watch, its dir creations rearm too
+        if (!m_watches.contains(WD))
+            m_watches[WD] = {parent, i, true};
+        parentWatches.emplace_back(WD);
+    }
+
+    std::erase_if(m_watches, [this, &parentWatches](const auto& w) {
+        if (!w.second.parent || std::ranges::find(parentWatches, w.first) != parentWatches.end())
+            return false;
+
+        inotify_rm_watch(m_inotifyFd.get(), w.first);
+        return true;
+    });
+}
+
+void CDesktopIndex::dropRoot(size_t root) {
+    dropDir(m_roots[root].string());
+    m_rootWatched[root] = false;
+}
+
+bool CDesktopIndex::scanDir(const std::filesystem::path& dir, size_t root) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir, ec) || ec)
+        return false;
+
+    if (m_inotifyFd.isValid()) {
+        const auto WD = inotify_add_watch(m_inotifyFd.get(), dir.c_str(), WATCH_MASK);
+
+        // same dir reached through another path (symlinks), it's already indexed under that one
+        const auto EXISTING = m_watches.find(WD);
+        if (EXISTING != m_watches.end() && !EXISTING->second.parent)
+            return false;
+
+        if (WD >= 0)
+            m_watches[WD] = {dir, root};
+    }
+
+    std::error_code ec_it;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec_it)) {
+        if (ec_it)
+            break;
+
+        std::error_code ecDir, ecLink;
+        const bool      IS_DIR = entry.is_directory(ecDir) && !ecDir;
+
+        if (IS_DIR) {
+            // don't follow symlinked dirs, they can loop back into the tree. If we can't tell, don't risk it
+            if (!entry.is_symlink(ecLink) && !ecLink)
+                scanDir(entry.path(), root);
+        } else if (entry.path().extension() == ".desktop")
+            indexEntry(entry.path(), root);
+    }
+
+    return true;
+}
+
+std::string CDesktopIndex::desktopFileId(const std::filesystem::path& path, size_t root) const {
+    // applications/kde4/foo.desktop -> kde4-foo.desktop
+    auto id = path.lexically_relative(m_roots[root]).string();
+    std::ranges::replace(id, '/', '-');
+    return id;
+}
+
+const CDesktopIndex::SEntry* CDesktopIndex::winner(const std::vector<SEntry>& entries) {
+    // only the entry from the most important data dir counts
+    const auto WINNER = std::ranges::min_element(entries, {}, &SEntry::root);
+    if (WINNER == entries.end() || WINNER->hidden)
+        return nullptr;
+    return &*WINNER;
+}
+
+void CDesktopIndex::updateId(const std::string& id, const std::function<void(std::vector<SEntry>&)>& fn) {
+    auto& entries = m_entries[id];
+
+    if (const auto WINNER = winner(entries)) {
+        for (const auto& k : WINNER->keys) {
+            const auto KEY = m_keys.find(k);
+            if (KEY == m_keys.end())
+                continue;
+
+            std::erase(KEY->second, id);
+            if (KEY->second.empty())
+                m_keys.erase(KEY);
+        }
+    }
+
+    fn(entries);
+
+    if (const auto WINNER = winner(entries)) {
+        for (const auto& k : WINNER->keys) {
+            m_keys[k].emplace_back(id);
+        }
+    }
+
+    if (entries.empty())
+        m_entries.erase(id);
+}
+
+void CDesktopIndex::indexEntry(const std::filesystem::path& path, size_t root) {
+    const auto PATH  = path.string();
+    auto       entry = parseEntry(path, root);
+
+    updateId(desktopFileId(path, root), [&PATH, &entry](std::vector<SEntry>& entries) {
+        std::erase_if(entries, [&PATH](const auto& e) { return e.path == PATH; });
+        if (entry)
+            entries.emplace_back(std::move(*entry));
+    });
+}
+
+std::optional<CDesktopIndex::SEntry> CDesktopIndex::parseEntry(const std::filesystem::path& path, size_t root) const {
+    std::ifstream file(path);
+    if (!file.good())
+        return std::nullopt;
+
+    std::string line, exec, tryExec;
+    bool        inEntry = false;
+    SEntry      entry;
+    entry.path = path.string();
+    entry.root = root;
+
+    while (std::getline(file, line)) {
+        line = trim(line);
+
+        if (line.empty() || line.starts_with('#'))
+            continue;
+
+        if (line.starts_with('[')) {
+            inEntry = line == "[Desktop Entry]";
+            continue;
+        }
+
+        if (!inEntry)
+            continue;
+
+        const auto EQ = line.find('=');
+        if (EQ == std::string::npos)
+            continue;
+
+        const auto KEY   = trim(line.substr(0, EQ));
+        const auto VALUE = trim(line.substr(EQ + 1));
+
+        if (KEY == "Exec")
+            exec = VALUE;
+        else if (KEY == "TryExec")
+            tryExec = VALUE;
+        else if (KEY == "Hidden")
+            entry.hidden = VALUE == "true";
+    }
+
+    // Hidden=true deletes the entry with this id, including ones from less important data dirs
+    if (entry.hidden)
+        return entry;
+
+    addAppId(entry.keys, path.stem().string());
+    if (!tryExec.empty())
+        addKey(entry.keys, fileName(tryExec));
+    const auto BIN = addExecKeys(entry.keys, exec);
+
+    // only keep what we'll be asked about. Entries without any are still kept, they override entries with the same id
+    std::erase_if(entry.keys, [this](const auto& k) { return !m_catalog.contains(k); });
+    if (entry.keys.empty())
+        return entry;
+
+    // stale entries, e.g. left behind by a removed AppImage, are ignored
+    if ((!tryExec.empty() && !binaryExists(tryExec)) || (!BIN.empty() && !binaryExists(BIN)))
+        return std::nullopt;
+
+    // nothing watches these, so provides() checks them again
+    for (const auto& b : {tryExec, BIN}) {
+        if (b.starts_with('/'))
+            entry.binaries.emplace_back(b);
+    }
+
+    return entry;
+}
+
+void CDesktopIndex::dropEntry(const std::filesystem::path& path, size_t root) {
+    const auto PATH = path.string();
+    updateId(desktopFileId(path, root), [&PATH](std::vector<SEntry>& entries) { std::erase_if(entries, [&PATH](const auto& e) { return e.path == PATH; }); });
+}
+
+void CDesktopIndex::dropDir(const std::string& dir) {
+    const auto               PREFIX = dir + "/";
+
+    std::vector<std::string> ids;
+    for (const auto& [id, entries] : m_entries) {
+        if (std::ranges::any_of(entries, [&PREFIX](const auto& e) { return e.path.starts_with(PREFIX); }))
+            ids.emplace_back(id);
+    }
+
+    for (const auto& id : ids) {
+        updateId(id, [&PREFIX](std::vector<SEntry>& entries) { std::erase_if(entries, [&PREFIX](const auto& e) { return e.path.starts_with(PREFIX); }); });
+    }
+
+    std::erase_if(m_watches, [this, &dir, &PREFIX](const auto& w) {
+        const auto PATH = w.second.path.string();
+        if (PATH != dir && !PATH.starts_with(PREFIX))
+            return false;
+
+        inotify_rm_watch(m_inotifyFd.get(), w.first);
+        return true;
+    });
+}
+
+void CDesktopIndex::processEvents() {
+    if (!m_inotifyFd.isValid())
+        return;
+
+    alignas(inotify_event) char buf[4096];
+    bool                        overflow = false, rearm = false;
+
+    while (true) {
+        const auto LEN = read(m_inotifyFd.get(), buf, sizeof(buf));
+        if (LEN <= 0)
+            break;
+
+        for (ssize_t off = 0; off < LEN;) {
+            const auto* ev = reinterpret_cast<const inotify_event*>(buf + off);
+            off += sizeof(inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+
+            const auto WATCH = m_watches.find(ev->wd);
+            if (WATCH == m_watches.end())
+                continue;
+
+            const auto ROOT    = WATCH->second.root;
+            const bool IS_ROOT = !WATCH->second.parent && WATCH->second.path == m_roots[ROOT];
+
+            if (ev->mask & (IN_IGNORED | IN_MOVE_SELF)) {
+                // the dir is gone. If it was a root, wait for it to come back
+                if (IS_ROOT) {
+                    dropRoot(ROOT);
+                    rearm = true;
+                } else if (WATCH->second.parent)
+                    rearm = true;
+
+                if (ev->mask & IN_IGNORED)
+                    m_watches.erase(ev->wd);
+                continue;
+            }
+
+            if (ev->len == 0)
+                continue;
+
+            if (WATCH->second.parent) {
+                rearm = rearm || (ev->mask & IN_ISDIR);
+                continue;
+            }
+
+            const auto PATH = WATCH->second.path / ev->name;
+
+            if (ev->mask & IN_ISDIR) {
+                rearm = rearm || (ev->mask & (IN_CREATE | IN_MOVED_TO));
+
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+                    scanDir(PATH, ROOT);
+                else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                    dropDir(PATH.string());
+                continue;
+            }
+
+            if (PATH.extension() != ".desktop")
+                continue;
+
+            if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                dropEntry(PATH, ROOT);
+            else
+                indexEntry(PATH, ROOT);
+        }
+    }
+
+    // we lost events, the index can't be trusted anymore
+    if (overflow)
+        rescan();
+    else if (rearm)
+        armRoots();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <hyprutils/os/FileDescriptor.hpp>
+
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// whether binName is in one of the PATH dirs
+bool appInPath(const std::string& binName);
+
+// Index of apps exposed through .desktop files (XDG data dirs, Flatpak exports, AppImage integrations),
+// for apps that aren't on PATH. Only binary names registered in the catalog are indexed.
+// Scanned once, then kept up to date from inotify events.
+class CDesktopIndex {
+  public:
+    CDesktopIndex();
+    ~CDesktopIndex() = default;
+
+    // binName will be looked up with provides()
+    void addCatalogName(const std::string& binName);
+
+    // applies pending inotify events (or rescans if the catalog changed), call once before a round of provides()
+    void refresh();
+
+    // whether any desktop entry provides binName via its Exec, TryExec or app id, and its binary still exists
+    bool provides(const std::string& binName) const;
+
+  private:
+    struct SEntry {
+        std::string              path;
+        size_t                   root   = 0; // index into m_roots, lower wins
+        bool                     hidden = false;
+        std::vector<std::string> keys;     // catalog names this entry provides
+        std::vector<std::string> binaries; // absolute TryExec / Exec paths, checked again on lookup
+    };
+
+    struct SWatch {
+        std::filesystem::path path;
+        size_t                root   = 0;
+        bool                  parent = false; // closest existing parent of a root that doesn't exist (yet)
+    };
+
+    void                                                      rescan();
+    void                                                      armRoots();
+    void                                                      dropRoot(size_t root);
+    bool                                                      scanDir(const std::filesystem::path& dir, size_t root);
+    std::string                                               desktopFileId(const std::filesystem::path& path, size_t root) const;
+    std::optional<SEntry>                                     parseEntry(const std::filesystem::path& path, size_t root) const;
+    static const SEntry*                                      winner(const std::vector<SEntry>& entries);
+    void                                                      updateId(const std::string& id, const std::function<void(std::vector<SEntry>&)>& fn);
+    void                                                      indexEntry(const std::filesystem::path& path, size_t root);
+    void                                                      dropEntry(const std::filesystem::path& path, size_t root);
+    void                                                      dropDir(const std::string& dir);
+    void                                                      processEvents();
+
+    Hyprutils::OS::CFileDescriptor                            m_inotifyFd;
+    std::vector<std::filesystem::path>                        m_roots;
+    std::vector<bool>                                         m_rootWatched;
+    std::unordered_map<int, SWatch>                           m_watches;
+    std::unordered_set<std::string>                           m_catalog;
+    bool                                                      m_dirty = true;
+
+    std::unordered_map<std::string, std::vector<SEntry>>      m_entries; // desktop file id -> entries from each data dir
+    std::unordered_map<std::string, std::vector<std::string>> m_keys;    // catalog name -> ids of winning entries providing it
+};
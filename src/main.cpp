@@ -21,6 +21,8 @@
 #include <fstream>
 #include <filesystem>
 
+#include "DesktopIndex.hpp"
+
 using namespace Hyprutils::Memory;
 using namespace Hyprutils::Math;
 using namespace Hyprutils::String;
@@ -120,24 +122,15 @@ static struct {
     size_t                                    tab = 0;
     std::vector<SP<SAppState>>                appStates;
     ASP<CTimer>                               appRefreshTimer, wikiOpenTimer;
+    UP<CDesktopIndex>                         desktopIndex;
 } state;
 
 static bool appExists(std::string binName) {
-    static auto PATH = getenv("PATH");
-
-    if (!PATH)
-        return false;
-
-    static CVarList paths(PATH, 0, ':', true);
-
-    for (const auto& p : paths) {
-        std::error_code ec;
-        if (!std::filesystem::exists(std::filesystem::path(p) / binName, ec) || ec)
-            continue;
+    if (appInPath(binName))
         return true;
-    }
 
-    return false;
+    // flatpaks, appimages etc. only reachable through a .desktop file
+    return state.desktopIndex && state.desktopIndex->provides(binName);
 }
 
 static bool appIsRunning(std::string binName) {
@@ -173,6 +166,8 @@ static void updateApps() {
 
     state.appRefreshTimer = state.backend->addTimer(std::chrono::seconds(1), [](ASP<CTimer> t, void* d) { updateApps(); }, nullptr);
 
+    state.desktopIndex->refresh();
+
     for (const auto& a : state.appStates) {
 
         bool found = false;
@@ -266,6 +261,10 @@ static void registerAppState(std::string&& name, std::vector<std::string>&& bina
     appState->labelEl     = CTextBuilder::begin()->color([] { return state.backend->getPalette()->m_colors.text; })->fontSize({CFontSize::HT_FONT_TEXT})->text("")->commence();
     appState->mandatory   = mandatory;
 
+    for (const auto& b : appState->binaryNames) {
+        state.desktopIndex->addCatalogName(b);
+    }
+
     std::string acceptedStr = "";
     for (const auto& b : appState->binaryNames) {
         acceptedStr += b + ", ";
@@ -476,6 +475,8 @@ static void initTabs() {
                 return;
             }
 
+            state.desktopIndex->refresh();
+
             if (appExists(app))
                 textEl->rebuild()->text(std::format("<span foreground=\"#22cc22\">✓ {} is installed</span>", app))->commence();
             else
@@ -560,6 +561,14 @@ int main(int argc, char** argv, char** envp) {
     auto window =
         CWindowBuilder::begin()->preferredSize(WINDOW_SIZE)->minSize(WINDOW_SIZE)->maxSize(WINDOW_SIZE)->appTitle("Welcome to Hyprland")->appClass("hyprland-welcome")->commence();
 
+    state.desktopIndex = makeUnique<CDesktopIndex>();
+    for (const auto& t : TERMINALS) {
+        state.desktopIndex->addCatalogName(t);
+    }
+    for (const auto& f : FILE_MANAGERS) {
+        state.desktopIndex->addCatalogName(f);
+    }
+
     initTabs();
 
     window->m_rootElement->addChild(CRectangleBuilder::begin()->color([] { return state.backend->getPalette()->m_colors.background; })->commence());
@@ -610,7 +619,7 @@ int main(int argc, char** argv, char** envp) {
                                  ->label("Launch terminal")
                                  ->onMainClick([w = WP<IWindow>{window}](SP<CButtonElement> self) {
                                      for (const auto& t : TERMINALS) {
-                                         if (!appExists(t))
+                                         if (!appInPath(t))
                                              continue;
 
                                          CProcess proc(t, {""});